@@ -1,20 +1,32 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "intrusive_set.h"
 
-template <typename Left, typename Right, typename CompareLeft, typename CompareRight>
+template <typename Left, typename Right, typename CompareLeft, typename CompareRight, std::size_t InlineCapacity>
 struct bimap;
 
-template <typename L, typename R, typename CL, typename CR>
-bool operator==(bimap<L, R, CL, CR> const &a, bimap<L, R, CL, CR> const &b) noexcept;
+template <typename Left, typename Right, typename CompareLeft, typename CompareRight, std::size_t InlineCapacity>
+struct bimap_builder;
 
-template <typename L, typename R, typename CL, typename CR>
-bool operator!=(bimap<L, R, CL, CR> const &a, bimap<L, R, CL, CR> const &b) noexcept;
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+bool operator==(bimap<L, R, CL, CR, N> const &a, bimap<L, R, CL, CR, N> const &b) noexcept;
 
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+bool operator!=(bimap<L, R, CL, CR, N> const &a, bimap<L, R, CL, CR, N> const &b) noexcept;
+
+// The first InlineCapacity pairs are stored inside the bimap object itself,
+// so small bimaps make no allocations.
 template <typename Left, typename Right,
-    typename CompareLeft = std::less<Left>, typename CompareRight = std::less<Right>>
+    typename CompareLeft = std::less<Left>, typename CompareRight = std::less<Right>, std::size_t InlineCapacity = 0>
 struct bimap
 {
     using left_t = Left;
@@ -118,6 +130,56 @@ private:
         {}
     };
 
+    // The fingerprint is only sound when equivalence under the comparator
+    // coincides with equality, i.e. when equivalent keys always hash alike.
+    // User types may order by fewer fields than they hash, so only standard
+    // scalar and string keys qualify.
+    template <typename T>
+    struct is_standard_key : std::disjunction<std::is_arithmetic<T>, std::is_enum<T>, std::is_pointer<T>>
+    {};
+
+    template <typename C, typename Traits, typename Alloc>
+    struct is_standard_key<std::basic_string<C, Traits, Alloc>> : std::true_type
+    {};
+
+    template <typename C, typename Traits>
+    struct is_standard_key<std::basic_string_view<C, Traits>> : std::true_type
+    {};
+
+    template <typename T, typename Compare, typename = void>
+    struct is_hash_consistent : std::false_type
+    {};
+
+    template <typename T, typename Compare>
+    struct is_hash_consistent<T, Compare, std::void_t<decltype(std::hash<T>()(std::declval<T const &>()))>> :
+        std::conjunction<is_standard_key<T>, std::disjunction<
+            std::is_same<Compare, std::less<T>>, std::is_same<Compare, std::less<>>,
+            std::is_same<Compare, std::greater<T>>, std::is_same<Compare, std::greater<>>>>
+    {};
+
+    static constexpr bool has_fingerprint =
+        is_hash_consistent<left_t, CompareLeft>::value && is_hash_consistent<right_t, CompareRight>::value;
+
+    struct no_fingerprint
+    {};
+
+    static_assert(InlineCapacity <= 64, "inline capacity is limited to 64 pairs");
+    static_assert(InlineCapacity == 0 ||
+            (std::is_nothrow_move_constructible_v<left_t> && std::is_nothrow_move_constructible_v<right_t>),
+        "inline storage requires nothrow move constructible keys");
+
+    template <std::size_t Capacity>
+    struct inline_pool
+    {
+        static constexpr std::uint64_t full = Capacity == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << Capacity) - 1;
+
+        alignas(node_t) unsigned char storage[Capacity * sizeof(node_t)];
+        std::uint64_t used = 0;
+    };
+
+    struct no_inline_pool
+    {};
+
 public:
     using left_iterator = typename left_key_traits::iterator;
     using right_iterator = typename right_key_traits::iterator;
@@ -127,11 +189,22 @@ public:
         right_set(sentinel, std::move(compare_right))
     {}
 
+    // Builds the bimap from a range of pairs, sorting both sides on several
+    // threads. A pair clashing with an earlier one is skipped, as with insert.
+    template <typename InputIt, typename = std::enable_if_t<std::is_base_of_v<
+        std::input_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>>>
+    bimap(InputIt first, InputIt last,
+        CompareLeft compare_left = CompareLeft(), CompareRight compare_right = CompareRight());
+
     bimap(bimap const &other);
-    bimap(bimap &&other) noexcept = default;
+
+    // Moves and swaps keep iterators to elements valid and take O(1), except
+    // that with InlineCapacity > 0 the inline pairs are relocated: this costs
+    // O(InlineCapacity) and invalidates iterators to them.
+    bimap(bimap &&other) noexcept;
 
     bimap &operator=(bimap const &other);
-    bimap &operator=(bimap &&other) noexcept = default;
+    bimap &operator=(bimap &&other) noexcept;
 
     void swap(bimap &other) noexcept;
 
@@ -151,6 +224,18 @@ public:
     left_iterator erase_left(left_iterator first, left_iterator last);
     right_iterator erase_right(right_iterator first, right_iterator last);
 
+    // Re-keys one side of the pair in place; the other side is left intact.
+    // Returns end iterator if the new key is already taken by another pair.
+    // If the key throws while being copied, the bimap is left unchanged.
+    // Iterators to the pair stay valid, unless the key's move assignment may
+    // throw: then the pair is moved to a new node and iterators to it on both
+    // sides are invalidated.
+    left_iterator replace_left(left_iterator it, left_t const &left);
+    left_iterator replace_left(left_iterator it, left_t &&left);
+
+    right_iterator replace_right(right_iterator it, right_t const &right);
+    right_iterator replace_right(right_iterator it, right_t &&right);
+
     left_iterator find_left(left_t const &left) const noexcept;
     right_iterator find_right(right_t const &right) const noexcept;
 
@@ -178,9 +263,24 @@ public:
     bool empty() const noexcept;
     std::size_t size() const noexcept;
 
+    // Call f(left, right) for every pair in left (right) order. This is the
+    // fastest way to scan the whole bimap; f must not modify it.
+    template <typename F>
+    void for_each_left(F &&f) const;
+
+    template <typename F>
+    void for_each_right(F &&f) const;
+
+    // Order-independent hash of the stored pairs, maintained on every
+    // modification. Equal bimaps always have equal fingerprints.
+    template <bool B = has_fingerprint, typename = std::enable_if_t<B>>
+    std::uint64_t fingerprint() const noexcept;
+
     friend bool operator==<>(bimap const &a, bimap const &b) noexcept;
     friend bool operator!=<>(bimap const &a, bimap const &b) noexcept;
 
+    friend struct bimap_builder<Left, Right, CompareLeft, CompareRight, InlineCapacity>;
+
 private:
     struct sentinel_t : left_key_traits::base_node, right_key_traits::base_node
     {} sentinel;
@@ -188,8 +288,67 @@ private:
     typename left_key_traits::set left_set;
     typename right_key_traits::set right_set;
 
+    [[no_unique_address]] std::conditional_t<has_fingerprint, std::uint64_t, no_fingerprint> hash_sum {};
+
+    [[no_unique_address]] std::conditional_t<InlineCapacity == 0, no_inline_pool, inline_pool<InlineCapacity>> pool;
+
+    template <typename L, typename R>
+    node_t *create_node(L &&left, R &&right);
+    void destroy_node(node_t *node) noexcept;
+    static std::size_t lowest_bit(std::uint64_t mask) noexcept;
+
+    void clear() noexcept;
+
+    void swap_trees(bimap &other) noexcept;
+    void relocate_inline(bimap &from) noexcept;
+
+    static std::uint64_t hash_pair(node_t const &node) noexcept;
+    void hash_add(node_t const &node) noexcept;
+    void hash_remove(node_t const &node) noexcept;
+
     template <typename L, typename R>
     left_iterator insert_forward(L &&left, R &&right);
+
+    static constexpr std::size_t parallel_sort_threshold = 1 << 15;
+
+    template <typename Traits>
+    static typename Traits::value const &key_of(node_t const *node) noexcept;
+
+    // Runs f on a new thread, or lazily on the waiting thread if none can be
+    // started.
+    template <typename F>
+    static std::future<void> spawn(F const &f);
+
+    // Sorts [first + bounds[lo], first + bounds[hi]): sorts each run between
+    // consecutive bounds, unless presorted, and merges them pairwise, using
+    // up to the given number of threads.
+    template <typename RandomIt, typename Compare>
+    static void merge_sort(RandomIt first, std::vector<std::size_t> const &bounds,
+        std::size_t lo, std::size_t hi, Compare const &comp, unsigned threads, bool presorted);
+
+    template <typename Traits>
+    auto index_less(std::vector<node_t *> const &nodes) const;
+
+    template <typename Traits, typename Compare>
+    static bool rank_nodes(std::vector<node_t *> const &nodes, std::vector<std::size_t> const &order,
+        Compare const &comp, std::vector<std::size_t> &rank);
+
+    void sort_bulk(std::vector<node_t *> const &nodes,
+        std::vector<std::size_t> &by_left, std::vector<std::size_t> &by_right, unsigned threads) const;
+
+    void merge_bulk(std::vector<node_t *> const &nodes,
+        std::vector<std::size_t> &by_left, std::vector<std::size_t> &by_right,
+        std::vector<std::size_t> const &bounds, unsigned threads, bool presorted) const;
+
+    void link_new(std::vector<node_t *> &nodes);
+
+    template <typename F>
+    void link_bulk(std::vector<node_t *> &nodes,
+        std::vector<std::size_t> const &by_left, std::vector<std::size_t> const &by_right, F &&on_duplicate);
+
+    template <typename Traits, typename K>
+    typename Traits::iterator replace_forward(
+        typename Traits::set &set, typename Traits::flipped::set &flipped_set, typename Traits::iterator it, K &&key);
 };
 
 #include "bimap.tpp"
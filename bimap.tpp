@@ -1,70 +1,77 @@
 #include "bimap.h"
 
-template <typename L, typename R, typename CL, typename CR>
+#include <algorithm>
+#include <future>
+#include <new>
+#include <numeric>
+#include <system_error>
+#include <thread>
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
 template <typename Tag>
-typename bimap<L, R, CL, CR>::template base_iterator<Tag>::reference bimap<L, R, CL, CR>::base_iterator<Tag>::operator*() const noexcept
+typename bimap<L, R, CL, CR, N>::template base_iterator<Tag>::reference bimap<L, R, CL, CR, N>::base_iterator<Tag>::operator*() const noexcept
 {
     return static_cast<typename traits::node const &>(*set_it).key;
 }
 
-template <typename L, typename R, typename CL, typename CR>
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
 template <typename Tag>
-typename bimap<L, R, CL, CR>::template base_iterator<Tag>::pointer bimap<L, R, CL, CR>::base_iterator<Tag>::operator->() const noexcept
+typename bimap<L, R, CL, CR, N>::template base_iterator<Tag>::pointer bimap<L, R, CL, CR, N>::base_iterator<Tag>::operator->() const noexcept
 {
     return &this->operator*();
 }
 
-template <typename L, typename R, typename CL, typename CR>
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
 template <typename Tag>
-typename bimap<L, R, CL, CR>::template base_iterator<Tag> &bimap<L, R, CL, CR>::base_iterator<Tag>::operator++() noexcept
+typename bimap<L, R, CL, CR, N>::template base_iterator<Tag> &bimap<L, R, CL, CR, N>::base_iterator<Tag>::operator++() noexcept
 {
     ++set_it;
     return *this;
 }
 
-template <typename L, typename R, typename CL, typename CR>
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
 template <typename Tag>
-typename bimap<L, R, CL, CR>::template base_iterator<Tag> bimap<L, R, CL, CR>::base_iterator<Tag>::operator++(int) & noexcept
+typename bimap<L, R, CL, CR, N>::template base_iterator<Tag> bimap<L, R, CL, CR, N>::base_iterator<Tag>::operator++(int) & noexcept
 {
     auto res = *this;
     ++set_it;
     return res;
 }
 
-template <typename L, typename R, typename CL, typename CR>
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
 template <typename Tag>
-typename bimap<L, R, CL, CR>::template base_iterator<Tag> &bimap<L, R, CL, CR>::base_iterator<Tag>::operator--() noexcept
+typename bimap<L, R, CL, CR, N>::template base_iterator<Tag> &bimap<L, R, CL, CR, N>::base_iterator<Tag>::operator--() noexcept
 {
     --set_it;
     return *this;
 }
 
-template <typename L, typename R, typename CL, typename CR>
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
 template <typename Tag>
-typename bimap<L, R, CL, CR>::template base_iterator<Tag> bimap<L, R, CL, CR>::base_iterator<Tag>::operator--(int) & noexcept
+typename bimap<L, R, CL, CR, N>::template base_iterator<Tag> bimap<L, R, CL, CR, N>::base_iterator<Tag>::operator--(int) & noexcept
 {
     auto res = *this;
     --set_it;
     return res;
 }
 
-template <typename L, typename R, typename CL, typename CR>
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
 template <typename Tag>
-bool bimap<L, R, CL, CR>::base_iterator<Tag>::operator==(base_iterator other) const noexcept
+bool bimap<L, R, CL, CR, N>::base_iterator<Tag>::operator==(base_iterator other) const noexcept
 {
     return set_it == other.set_it;
 }
 
-template <typename L, typename R, typename CL, typename CR>
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
 template <typename Tag>
-bool bimap<L, R, CL, CR>::base_iterator<Tag>::operator!=(base_iterator other) const noexcept
+bool bimap<L, R, CL, CR, N>::base_iterator<Tag>::operator!=(base_iterator other) const noexcept
 {
     return set_it != other.set_it;
 }
 
-template <typename L, typename R, typename CL, typename CR>
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
 template <typename T>
-typename bimap<L, R, CL, CR>::template base_iterator<T>::flipped_iterator bimap<L, R, CL, CR>::base_iterator<T>::flip() const noexcept
+typename bimap<L, R, CL, CR, N>::template base_iterator<T>::flipped_iterator bimap<L, R, CL, CR, N>::base_iterator<T>::flip() const noexcept
 {
     auto &node = *set_it;
     using flipped_node_t = typename traits::flipped::base_node const &;
@@ -76,99 +83,264 @@ typename bimap<L, R, CL, CR>::template base_iterator<T>::flipped_iterator bimap<
     return flipped_iterator(static_cast<flipped_node_t>(static_cast<node_t const &>(node)));
 }
 
-template <typename L, typename R, typename CL, typename CR>
-bimap<L, R, CL, CR>::bimap(bimap const &other) : bimap(other.left_set.key_comp(), other.right_set.key_comp())
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+template <typename InputIt, typename>
+bimap<L, R, CL, CR, N>::bimap(InputIt first, InputIt last, CL compare_left, CR compare_right) :
+    bimap(std::move(compare_left), std::move(compare_right))
 {
-    auto const end = other.end_left();
-    for (auto it = other.begin_left(); it != end; ++it) {
-        insert(*it, *it.flip());
+    std::vector<node_t *> nodes;
+    try {
+        for (; first != last; ++first) {
+            auto &&pair = *first;
+            nodes.push_back(nullptr);
+            nodes.back() = create_node(
+                std::forward<decltype(pair)>(pair).first, std::forward<decltype(pair)>(pair).second);
+        }
+    } catch (...) {
+        for (auto *node : nodes) {
+            if (node) {
+                destroy_node(node);
+            }
+        }
+        throw;
     }
+
+    link_new(nodes);
 }
 
-template <typename L, typename R, typename CL, typename CR>
-bimap<L, R, CL, CR> &bimap<L, R, CL, CR>::operator=(bimap const &other)
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+bimap<L, R, CL, CR, N>::bimap(bimap const &other) : bimap(other.left_set.key_comp(), other.right_set.key_comp())
 {
-    erase_left(begin_left(), end_left());
+    // Copies are made in left order, so the left tree is linked as is. The
+    // right order comes from walking other's right tree and finding the copy
+    // of each source node in an open-addressing table keyed by its address.
+    if (other.empty()) {
+        return;
+    }
+
+    std::size_t bits = 1;
+    while ((std::size_t(1) << bits) < 2 * other.size()) {
+        ++bits;
+    }
+    std::vector<std::pair<node_t const *, node_t *>> copies(std::size_t(1) << bits);
+    auto slot = [&copies, bits](node_t const *source) {
+        auto h = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(source)) * 0x9e3779b97f4a7c15;
+        auto i = static_cast<std::size_t>(h >> (64 - bits));
+        while (copies[i].first && copies[i].first != source) {
+            i = (i + 1) & (copies.size() - 1);
+        }
+        return i;
+    };
+
+    std::vector<node_t *> nodes;
+    nodes.reserve(other.size());
+    try {
+        other.left_set.for_each([&](typename left_key_traits::node const &node) {
+            auto *source = &static_cast<node_t const &>(node);
+            auto *copy = create_node(key_of<left_key_traits>(source), key_of<right_key_traits>(source));
+            nodes.push_back(copy);
+            copies[slot(source)] = {source, copy};
+        });
+    } catch (...) {
+        for (auto *node : nodes) {
+            destroy_node(node);
+        }
+        throw;
+    }
 
-    auto const end = other.end_left();
-    for (auto it = other.begin_left(); it != end; ++it) {
-        insert(*it, *it.flip());
+    left_set.link_sorted(nodes.begin(), nodes.end());
+    for (auto *node : nodes) {
+        hash_add(*node);
     }
 
+    nodes.clear();
+    other.right_set.for_each([&](typename right_key_traits::node const &node) {
+        nodes.push_back(copies[slot(&static_cast<node_t const &>(node))].second);
+    });
+    right_set.link_sorted(nodes.begin(), nodes.end());
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+bimap<L, R, CL, CR, N>::bimap(bimap &&other) noexcept : bimap(other.left_set.key_comp(), other.right_set.key_comp())
+{
+    swap_trees(other);
+    relocate_inline(other);
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+bimap<L, R, CL, CR, N> &bimap<L, R, CL, CR, N>::operator=(bimap const &other)
+{
+    bimap(other).swap(*this);
+    return *this;
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+bimap<L, R, CL, CR, N> &bimap<L, R, CL, CR, N>::operator=(bimap &&other) noexcept
+{
+    bimap(std::move(other)).swap(*this);
     return *this;
 }
 
-template <typename L, typename R, typename CL, typename CR>
-void bimap<L, R, CL, CR>::swap(bimap &other) noexcept
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+void bimap<L, R, CL, CR, N>::swap(bimap &other) noexcept
 {
-    bimap tmp = std::move(other);
-    other = std::move(*this);
-    *this = std::move(tmp);
+    if constexpr (N == 0) {
+        swap_trees(other);
+    } else {
+        bimap tmp(std::move(other));
+        other.swap_trees(*this);
+        other.relocate_inline(*this);
+        swap_trees(tmp);
+        relocate_inline(tmp);
+    }
 }
 
-template <typename L, typename R, typename CL, typename CR>
-bimap<L, R, CL, CR>::~bimap()
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+void bimap<L, R, CL, CR, N>::clear() noexcept
 {
-    erase_left(begin_left(), end_left());
+    right_set.clear();
+    left_set.clear_and_dispose([this](typename left_key_traits::node &node) {
+        destroy_node(&static_cast<node_t &>(node));
+    });
+    hash_sum = {};
 }
 
-template <typename L, typename R, typename CL, typename CR>
-typename bimap<L, R, CL, CR>::left_iterator bimap<L, R, CL, CR>::insert(left_t const &left, right_t const &right)
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+void bimap<L, R, CL, CR, N>::swap_trees(bimap &other) noexcept
+{
+    left_set.swap(other.left_set);
+    right_set.swap(other.right_set);
+    std::swap(hash_sum, other.hash_sum);
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+void bimap<L, R, CL, CR, N>::relocate_inline(bimap &from) noexcept
+{
+    if constexpr (N > 0) {
+        assert(pool.used == 0);
+        while (from.pool.used) {
+            auto i = lowest_bit(from.pool.used);
+            auto *old = std::launder(reinterpret_cast<node_t *>(from.pool.storage + i * sizeof(node_t)));
+            auto *node = create_node(
+                std::move(static_cast<typename left_key_traits::node &>(*old).key),
+                std::move(static_cast<typename right_key_traits::node &>(*old).key));
+            left_set.substitute(*old, *node);
+            right_set.substitute(*old, *node);
+            from.destroy_node(old);
+        }
+    }
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+template <typename Left, typename Right>
+typename bimap<L, R, CL, CR, N>::node_t *bimap<L, R, CL, CR, N>::create_node(Left &&left, Right &&right)
+{
+    if constexpr (N > 0) {
+        if (pool.used != pool.full) {
+            auto i = lowest_bit(~pool.used);
+            auto *node = new (pool.storage + i * sizeof(node_t))
+                node_t(std::forward<Left>(left), std::forward<Right>(right));
+            pool.used |= std::uint64_t(1) << i;
+            return node;
+        }
+    }
+    return new node_t(std::forward<Left>(left), std::forward<Right>(right));
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+std::size_t bimap<L, R, CL, CR, N>::lowest_bit(std::uint64_t mask) noexcept
+{
+    assert(mask != 0);
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(mask);
+#else
+    std::size_t i = 0;
+    while (!(mask >> i & 1)) {
+        ++i;
+    }
+    return i;
+#endif
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+void bimap<L, R, CL, CR, N>::destroy_node(node_t *node) noexcept
+{
+    if constexpr (N > 0) {
+        auto *ptr = reinterpret_cast<unsigned char *>(node);
+        if (std::less_equal<>()(pool.storage, ptr) && std::less<>()(ptr, pool.storage + sizeof(pool.storage))) {
+            node->~node_t();
+            pool.used &= ~(std::uint64_t(1) << (ptr - pool.storage) / sizeof(node_t));
+            return;
+        }
+    }
+    delete node;
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+bimap<L, R, CL, CR, N>::~bimap()
+{
+    clear();
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::left_iterator bimap<L, R, CL, CR, N>::insert(left_t const &left, right_t const &right)
 {
     return insert_forward(left, right);
 }
 
-template <typename L, typename R, typename CL, typename CR>
-typename bimap<L, R, CL, CR>::left_iterator bimap<L, R, CL, CR>::insert(left_t &&left, right_t const &right)
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::left_iterator bimap<L, R, CL, CR, N>::insert(left_t &&left, right_t const &right)
 {
     return insert_forward(std::move(left), right);
 }
 
-template <typename L, typename R, typename CL, typename CR>
-typename bimap<L, R, CL, CR>::left_iterator bimap<L, R, CL, CR>::insert(left_t const &left, right_t &&right)
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::left_iterator bimap<L, R, CL, CR, N>::insert(left_t const &left, right_t &&right)
 {
     return insert_forward(left, std::move(right));
 }
 
-template <typename L, typename R, typename CL, typename CR>
-typename bimap<L, R, CL, CR>::left_iterator bimap<L, R, CL, CR>::insert(left_t &&left, right_t &&right)
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::left_iterator bimap<L, R, CL, CR, N>::insert(left_t &&left, right_t &&right)
 {
     return insert_forward(std::move(left), std::move(right));
 }
 
-template <typename L, typename R, typename CL, typename CR>
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
 template <typename Left, typename Right>
-typename bimap<L, R, CL, CR>::left_iterator bimap<L, R, CL, CR>::insert_forward(Left &&left, Right &&right)
+typename bimap<L, R, CL, CR, N>::left_iterator bimap<L, R, CL, CR, N>::insert_forward(Left &&left, Right &&right)
 {
     if (find_left(left) != end_left() || find_right(right) != end_right()) {
         return end_left();
     }
 
-    auto &node = *new node_t(std::forward<Left>(left), std::forward<Right>(right));
+    auto &node = *create_node(std::forward<Left>(left), std::forward<Right>(right));
     left_set.link(node);
     right_set.link(node);
+    hash_add(node);
 
     return left_iterator(node);
 }
 
-template <typename L, typename R, typename CL, typename CR>
-typename bimap<L, R, CL, CR>::left_iterator bimap<L, R, CL, CR>::erase_left(left_iterator it)
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::left_iterator bimap<L, R, CL, CR, N>::erase_left(left_iterator it)
 {
     auto old_it = it++;
     auto *ptr = static_cast<node_t *>(&left_set.unlink(old_it.set_it));
     right_set.unlink(old_it.flip().set_it);
-    delete ptr;
+    hash_remove(*ptr);
+    destroy_node(ptr);
     return it;
 }
 
-template <typename L, typename R, typename CL, typename CR>
-typename bimap<L, R, CL, CR>::right_iterator bimap<L, R, CL, CR>::erase_right(right_iterator it)
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::right_iterator bimap<L, R, CL, CR, N>::erase_right(right_iterator it)
 {
     return erase_left(it.flip()).flip();
 }
 
-template <typename L, typename R, typename CL, typename CR>
-bool bimap<L, R, CL, CR>::erase_left(left_t const &left)
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+bool bimap<L, R, CL, CR, N>::erase_left(left_t const &left)
 {
     if (auto it = find_left(left); it != end_left()) {
         erase_left(it);
@@ -177,8 +349,8 @@ bool bimap<L, R, CL, CR>::erase_left(left_t const &left)
     return false;
 }
 
-template <typename L, typename R, typename CL, typename CR>
-bool bimap<L, R, CL, CR>::erase_right(right_t const &right)
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+bool bimap<L, R, CL, CR, N>::erase_right(right_t const &right)
 {
     if (auto it = find_right(right); it != end_right()) {
         erase_right(it);
@@ -187,38 +359,294 @@ bool bimap<L, R, CL, CR>::erase_right(right_t const &right)
     return false;
 }
 
-template <typename L, typename R, typename CL, typename CR>
-typename bimap<L, R, CL, CR>::left_iterator bimap<L, R, CL, CR>::erase_left(left_iterator first, left_iterator last)
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::left_iterator bimap<L, R, CL, CR, N>::erase_left(left_iterator first, left_iterator last)
 {
+    if (first == begin_left() && last == end_left()) {
+        clear();
+        return end_left();
+    }
     while (first != last) {
         erase_left(first++);
     }
     return last;
 }
 
-template <typename L, typename R, typename CL, typename CR>
-typename bimap<L, R, CL, CR>::right_iterator bimap<L, R, CL, CR>::erase_right(right_iterator first, right_iterator last)
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::right_iterator bimap<L, R, CL, CR, N>::erase_right(right_iterator first, right_iterator last)
 {
+    if (first == begin_right() && last == end_right()) {
+        clear();
+        return end_right();
+    }
     while (first != last) {
         erase_right(first++);
     }
     return last;
 }
 
-template <typename L, typename R, typename CL, typename CR>
-typename bimap<L, R, CL, CR>::left_iterator bimap<L, R, CL, CR>::find_left(left_t const &left) const noexcept
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::left_iterator bimap<L, R, CL, CR, N>::replace_left(left_iterator it, left_t const &left)
+{
+    return replace_forward<left_key_traits>(left_set, right_set, it, left);
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::left_iterator bimap<L, R, CL, CR, N>::replace_left(left_iterator it, left_t &&left)
+{
+    return replace_forward<left_key_traits>(left_set, right_set, it, std::move(left));
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::right_iterator bimap<L, R, CL, CR, N>::replace_right(right_iterator it, right_t const &right)
+{
+    return replace_forward<right_key_traits>(right_set, left_set, it, right);
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::right_iterator bimap<L, R, CL, CR, N>::replace_right(right_iterator it, right_t &&right)
+{
+    return replace_forward<right_key_traits>(right_set, left_set, it, std::move(right));
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+template <typename Traits>
+typename Traits::value const &bimap<L, R, CL, CR, N>::key_of(node_t const *node) noexcept
+{
+    return static_cast<typename Traits::node const *>(node)->key;
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+template <typename F>
+std::future<void> bimap<L, R, CL, CR, N>::spawn(F const &f)
+{
+    try {
+        return std::async(std::launch::async, f);
+    } catch (std::system_error const &) {
+        return std::async(std::launch::deferred, f);
+    }
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+template <typename RandomIt, typename Compare>
+void bimap<L, R, CL, CR, N>::merge_sort(RandomIt first, std::vector<std::size_t> const &bounds,
+    std::size_t lo, std::size_t hi, Compare const &comp, unsigned threads, bool presorted)
+{
+    if (hi - lo < 2) {
+        if (hi > lo && !presorted) {
+            std::sort(first + bounds[lo], first + bounds[hi], comp);
+        }
+        return;
+    }
+
+    auto mid = lo + (hi - lo) / 2;
+    if (threads < 2) {
+        merge_sort(first, bounds, lo, mid, comp, 1, presorted);
+        merge_sort(first, bounds, mid, hi, comp, 1, presorted);
+    } else {
+        auto half = spawn([&] { merge_sort(first, bounds, lo, mid, comp, threads / 2, presorted); });
+        merge_sort(first, bounds, mid, hi, comp, threads - threads / 2, presorted);
+        half.get();
+    }
+    std::inplace_merge(first + bounds[lo], first + bounds[mid], first + bounds[hi], comp);
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+template <typename Traits, typename Compare>
+bool bimap<L, R, CL, CR, N>::rank_nodes(std::vector<node_t *> const &nodes, std::vector<std::size_t> const &order,
+    Compare const &comp, std::vector<std::size_t> &rank)
+{
+    bool duplicates = false;
+    rank.resize(nodes.size());
+    for (std::size_t i = 0, r = 0; i < order.size(); ++i) {
+        if (i > 0 && !comp(key_of<Traits>(nodes[order[i - 1]]), key_of<Traits>(nodes[order[i]]))) {
+            duplicates = true;
+        } else {
+            r = i;
+        }
+        rank[order[i]] = r;
+    }
+    return duplicates;
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+template <typename Traits>
+auto bimap<L, R, CL, CR, N>::index_less(std::vector<node_t *> const &nodes) const
+{
+    auto comp = [this] {
+        if constexpr (std::is_same_v<Traits, left_key_traits>) {
+            return left_set.key_comp();
+        } else {
+            return right_set.key_comp();
+        }
+    }();
+    return [&nodes, comp](std::size_t a, std::size_t b) {
+        return comp(key_of<Traits>(nodes[a]), key_of<Traits>(nodes[b]));
+    };
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+void bimap<L, R, CL, CR, N>::sort_bulk(std::vector<node_t *> const &nodes,
+    std::vector<std::size_t> &by_left, std::vector<std::size_t> &by_right, unsigned threads) const
+{
+    by_left.resize(nodes.size());
+    std::iota(by_left.begin(), by_left.end(), 0);
+    by_right = by_left;
+
+    if (nodes.size() < parallel_sort_threshold) {
+        threads = 1;
+    }
+    std::vector<std::size_t> bounds(threads + 1);
+    for (unsigned i = 0; i <= threads; ++i) {
+        bounds[i] = nodes.size() * i / threads;
+    }
+    merge_bulk(nodes, by_left, by_right, bounds, threads, false);
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+void bimap<L, R, CL, CR, N>::merge_bulk(std::vector<node_t *> const &nodes,
+    std::vector<std::size_t> &by_left, std::vector<std::size_t> &by_right,
+    std::vector<std::size_t> const &bounds, unsigned threads, bool presorted) const
+{
+    auto runs = bounds.size() - 1;
+    auto left_less = index_less<left_key_traits>(nodes);
+    auto right_less = index_less<right_key_traits>(nodes);
+
+    if (threads < 2) {
+        merge_sort(by_left.begin(), bounds, 0, runs, left_less, 1, presorted);
+        merge_sort(by_right.begin(), bounds, 0, runs, right_less, 1, presorted);
+        return;
+    }
+
+    auto left_sorted = spawn([&] {
+        merge_sort(by_left.begin(), bounds, 0, runs, left_less, threads / 2, presorted);
+    });
+    merge_sort(by_right.begin(), bounds, 0, runs, right_less, threads - threads / 2, presorted);
+    left_sorted.get();
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+void bimap<L, R, CL, CR, N>::link_new(std::vector<node_t *> &nodes)
+{
+    std::vector<std::size_t> by_left, by_right;
+    try {
+        sort_bulk(nodes, by_left, by_right, std::max(std::thread::hardware_concurrency(), 2u));
+    } catch (...) {
+        for (auto *node : nodes) {
+            destroy_node(node);
+        }
+        throw;
+    }
+
+    link_bulk(nodes, by_left, by_right, [](left_t const &, right_t const &) {});
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+template <typename F>
+void bimap<L, R, CL, CR, N>::link_bulk(std::vector<node_t *> &nodes,
+    std::vector<std::size_t> const &by_left, std::vector<std::size_t> const &by_right, F &&on_duplicate)
+{
+    std::vector<node_t *> sorted, rejected;
+    std::vector<bool> accepted;
+    try {
+        accepted.assign(nodes.size(), true);
+        std::vector<std::size_t> left_rank, right_rank;
+        bool left_duplicates = rank_nodes<left_key_traits>(nodes, by_left, left_set.key_comp(), left_rank);
+        bool right_duplicates = rank_nodes<right_key_traits>(nodes, by_right, right_set.key_comp(), right_rank);
+
+        if (left_duplicates || right_duplicates) {
+            std::vector<bool> left_taken(nodes.size()), right_taken(nodes.size());
+            for (std::size_t i = 0; i < nodes.size(); ++i) {
+                if (left_taken[left_rank[i]] || right_taken[right_rank[i]]) {
+                    accepted[i] = false;
+                    rejected.push_back(nodes[i]);
+                } else {
+                    left_taken[left_rank[i]] = right_taken[right_rank[i]] = true;
+                }
+            }
+        }
+        sorted.reserve(nodes.size() - rejected.size());
+
+        for (auto *node : rejected) {
+            on_duplicate(key_of<left_key_traits>(node), key_of<right_key_traits>(node));
+        }
+    } catch (...) {
+        for (auto *node : nodes) {
+            destroy_node(node);
+        }
+        throw;
+    }
+
+    for (auto i : by_left) {
+        if (accepted[i]) {
+            sorted.push_back(nodes[i]);
+            hash_add(*nodes[i]);
+        }
+    }
+    left_set.link_sorted(sorted.begin(), sorted.end());
+
+    sorted.clear();
+    for (auto i : by_right) {
+        if (accepted[i]) {
+            sorted.push_back(nodes[i]);
+        }
+    }
+    right_set.link_sorted(sorted.begin(), sorted.end());
+
+    for (auto *node : rejected) {
+        destroy_node(node);
+    }
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+template <typename Traits, typename K>
+typename Traits::iterator bimap<L, R, CL, CR, N>::replace_forward(
+    typename Traits::set &set, typename Traits::flipped::set &flipped_set, typename Traits::iterator it, K &&key)
+{
+    if (auto found = set.find(key); found != set.end() && found != it.set_it) {
+        return set.end();
+    }
+
+    typename Traits::value tmp(std::forward<K>(key));
+    auto *node = &static_cast<node_t &>(const_cast<typename Traits::base_node &>(*it.set_it));
+
+    if constexpr (std::is_nothrow_move_assignable_v<typename Traits::value>) {
+        set.unlink(it.set_it);
+        hash_remove(*node);
+        static_cast<typename Traits::node &>(*node).key = std::move(tmp);
+    } else {
+        node_t *fresh;
+        if constexpr (std::is_same_v<Traits, left_key_traits>) {
+            fresh = create_node(std::move(tmp), key_of<right_key_traits>(node));
+        } else {
+            fresh = create_node(key_of<left_key_traits>(node), std::move(tmp));
+        }
+        set.unlink(it.set_it);
+        flipped_set.substitute(*node, *fresh);
+        hash_remove(*node);
+        destroy_node(node);
+        node = fresh;
+    }
+    hash_add(*node);
+    set.link(*node);
+
+    return typename Traits::iterator(static_cast<typename Traits::base_node const &>(*node));
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::left_iterator bimap<L, R, CL, CR, N>::find_left(left_t const &left) const noexcept
 {
     return left_set.find(left);
 }
 
-template <typename L, typename R, typename CL, typename CR>
-typename bimap<L, R, CL, CR>::right_iterator bimap<L, R, CL, CR>::find_right(right_t const &right) const noexcept
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::right_iterator bimap<L, R, CL, CR, N>::find_right(right_t const &right) const noexcept
 {
     return right_set.find(right);
 }
 
-template <typename L, typename R, typename CL, typename CR>
-typename bimap<L, R, CL, CR>::right_t const &bimap<L, R, CL, CR>::at_left(left_t const &key) const
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::right_t const &bimap<L, R, CL, CR, N>::at_left(left_t const &key) const
 {
     if (auto it = find_left(key); it != end_left()) {
         return *it.flip();
@@ -226,8 +654,8 @@ typename bimap<L, R, CL, CR>::right_t const &bimap<L, R, CL, CR>::at_left(left_t
     throw std::out_of_range("No such element");
 }
 
-template <typename L, typename R, typename CL, typename CR>
-typename bimap<L, R, CL, CR>::left_t const &bimap<L, R, CL, CR>::at_right(right_t const &key) const
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::left_t const &bimap<L, R, CL, CR, N>::at_right(right_t const &key) const
 {
     if (auto it = find_right(key); it != end_right()) {
         return *it.flip();
@@ -235,9 +663,9 @@ typename bimap<L, R, CL, CR>::left_t const &bimap<L, R, CL, CR>::at_right(right_
     throw std::out_of_range("No such element");
 }
 
-template <typename L, typename R, typename CL, typename CR>
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
 template <typename, typename>
-typename bimap<L, R, CL, CR>::right_t const &bimap<L, R, CL, CR>::at_left_or_default(left_t const &key)
+typename bimap<L, R, CL, CR, N>::right_t const &bimap<L, R, CL, CR, N>::at_left_or_default(left_t const &key)
 {
     auto it_left = find_left(key);
     if (it_left != end_left()) {
@@ -247,18 +675,15 @@ typename bimap<L, R, CL, CR>::right_t const &bimap<L, R, CL, CR>::at_left_or_def
     right_t r {};
     auto it_right = find_right(r);
     if (it_right != end_right()) {
-        auto &node = right_set.unlink(it_right.set_it);
-        static_cast<typename left_key_traits::node &>(static_cast<node_t &>(node)).key = key;
-        right_set.link(node);
-        return node.key;
+        return *replace_left(it_right.flip(), key).flip();
     }
 
     return *insert(key, std::move(r)).flip();
 }
 
-template <typename L, typename R, typename CL, typename CR>
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
 template <typename, typename>
-typename bimap<L, R, CL, CR>::left_t const &bimap<L, R, CL, CR>::at_right_or_default(const right_t &key)
+typename bimap<L, R, CL, CR, N>::left_t const &bimap<L, R, CL, CR, N>::at_right_or_default(const right_t &key)
 {
     auto it_right = find_right(key);
     if (it_right != end_right()) {
@@ -268,101 +693,166 @@ typename bimap<L, R, CL, CR>::left_t const &bimap<L, R, CL, CR>::at_right_or_def
     left_t l {};
     auto it_left = find_left(l);
     if (it_left != end_left()) {
-        auto &node = left_set.unlink(it_left.set_it);
-        static_cast<typename right_key_traits::node &>(static_cast<node_t &>(node)).key = key;
-        left_set.link(node);
-        return node.key;
+        return *replace_right(it_left.flip(), key).flip();
     }
 
     return *insert(std::move(l), key);
 }
 
-template <typename L, typename R, typename CL, typename CR>
-typename bimap<L, R, CL, CR>::left_iterator bimap<L, R, CL, CR>::lower_bound_left(left_t const &left) const noexcept
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::left_iterator bimap<L, R, CL, CR, N>::lower_bound_left(left_t const &left) const noexcept
 {
     return left_set.lower_bound(left);
 }
 
-template <typename L, typename R, typename CL, typename CR>
-typename bimap<L, R, CL, CR>::left_iterator bimap<L, R, CL, CR>::upper_bound_left(left_t const &left) const noexcept
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::left_iterator bimap<L, R, CL, CR, N>::upper_bound_left(left_t const &left) const noexcept
 {
     return left_set.upper_bound(left);
 }
 
-template <typename L, typename R, typename CL, typename CR>
-typename bimap<L, R, CL, CR>::right_iterator bimap<L, R, CL, CR>::lower_bound_right(right_t const &right) const noexcept
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::right_iterator bimap<L, R, CL, CR, N>::lower_bound_right(right_t const &right) const noexcept
 {
     return right_set.lower_bound(right);
 }
 
-template <typename L, typename R, typename CL, typename CR>
-typename bimap<L, R, CL, CR>::right_iterator bimap<L, R, CL, CR>::upper_bound_right(right_t const &right) const noexcept
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::right_iterator bimap<L, R, CL, CR, N>::upper_bound_right(right_t const &right) const noexcept
 {
     return right_set.upper_bound(right);
 }
 
-template <typename L, typename R, typename CL, typename CR>
-typename bimap<L, R, CL, CR>::left_iterator bimap<L, R, CL, CR>::begin_left() const noexcept
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::left_iterator bimap<L, R, CL, CR, N>::begin_left() const noexcept
 {
     return left_set.begin();
 }
 
-template <typename L, typename R, typename CL, typename CR>
-typename bimap<L, R, CL, CR>::left_iterator bimap<L, R, CL, CR>::end_left() const noexcept
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::left_iterator bimap<L, R, CL, CR, N>::end_left() const noexcept
 {
     return left_set.end();
 }
 
-template <typename L, typename R, typename CL, typename CR>
-typename bimap<L, R, CL, CR>::right_iterator bimap<L, R, CL, CR>::begin_right() const noexcept
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::right_iterator bimap<L, R, CL, CR, N>::begin_right() const noexcept
 {
     return right_set.begin();
 }
 
-template <typename L, typename R, typename CL, typename CR>
-typename bimap<L, R, CL, CR>::right_iterator bimap<L, R, CL, CR>::end_right() const noexcept
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap<L, R, CL, CR, N>::right_iterator bimap<L, R, CL, CR, N>::end_right() const noexcept
 {
     return right_set.end();
 }
 
-template <typename L, typename R, typename CL, typename CR>
-bool bimap<L, R, CL, CR>::empty() const noexcept
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+bool bimap<L, R, CL, CR, N>::empty() const noexcept
 {
     return left_set.empty();
 }
 
-template <typename L, typename R, typename CL, typename CR>
-std::size_t bimap<L, R, CL, CR>::size() const noexcept
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+std::size_t bimap<L, R, CL, CR, N>::size() const noexcept
 {
     return left_set.size();
 }
 
-template <typename L, typename R, typename CL, typename CR>
-bool operator==(bimap<L, R, CL, CR> const &a, bimap<L, R, CL, CR> const &b) noexcept
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+template <typename F>
+void bimap<L, R, CL, CR, N>::for_each_left(F &&f) const
 {
-    if (a.size() != b.size()) {
-        return false;
+    left_set.for_each([&f](typename left_key_traits::node const &node) {
+        auto *pair = &static_cast<node_t const &>(node);
+        f(key_of<left_key_traits>(pair), key_of<right_key_traits>(pair));
+    });
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+template <typename F>
+void bimap<L, R, CL, CR, N>::for_each_right(F &&f) const
+{
+    right_set.for_each([&f](typename right_key_traits::node const &node) {
+        auto *pair = &static_cast<node_t const &>(node);
+        f(key_of<left_key_traits>(pair), key_of<right_key_traits>(pair));
+    });
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+template <bool, typename>
+std::uint64_t bimap<L, R, CL, CR, N>::fingerprint() const noexcept
+{
+    return hash_sum;
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+std::uint64_t bimap<L, R, CL, CR, N>::hash_pair(node_t const &node) noexcept
+{
+    if constexpr (has_fingerprint) {
+        auto mix = [](std::uint64_t x) {
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+            return x ^ (x >> 31);
+        };
+
+        auto &left = static_cast<typename left_key_traits::node const &>(node).key;
+        auto &right = static_cast<typename right_key_traits::node const &>(node).key;
+        return mix(std::hash<left_t>()(left) ^ mix(std::hash<right_t>()(right)));
+    } else {
+        return 0;
     }
+}
 
-    auto const a_end = a.end_left();
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+void bimap<L, R, CL, CR, N>::hash_add(node_t const &node) noexcept
+{
+    if constexpr (has_fingerprint) {
+        hash_sum += hash_pair(node);
+    }
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+void bimap<L, R, CL, CR, N>::hash_remove(node_t const &node) noexcept
+{
+    if constexpr (has_fingerprint) {
+        hash_sum -= hash_pair(node);
+    }
+}
 
-    for (auto a_it = a.begin_left(), b_it = b.begin_left(); a_it != a_end; ++a_it, ++b_it) {
-        auto &a_l = *a_it;
-        auto &b_l = *b_it;
-        auto &a_r = *a_it.flip();
-        auto &b_r = *b_it.flip();
-        auto comp_left = a.left_set.key_comp();
-        auto comp_right = a.right_set.key_comp();
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+bool operator==(bimap<L, R, CL, CR, N> const &a, bimap<L, R, CL, CR, N> const &b) noexcept
+{
+    if (a.size() != b.size()) {
+        return false;
+    }
 
-        if (comp_left(a_l, b_l) || comp_left(b_l, a_l) || comp_right(a_r, b_r) || comp_right(b_r, a_r)) {
+    if constexpr (bimap<L, R, CL, CR, N>::has_fingerprint) {
+        if (a.hash_sum != b.hash_sum) {
             return false;
         }
     }
-    return true;
+
+    using bimap_t = bimap<L, R, CL, CR, N>;
+    using left_traits = typename bimap_t::left_key_traits;
+    using right_traits = typename bimap_t::right_key_traits;
+    using node_t = typename bimap_t::node_t;
+
+    auto comp_left = a.left_set.key_comp();
+    auto comp_right = a.right_set.key_comp();
+
+    return a.left_set.equal(b.left_set, [&](typename left_traits::node const &x, typename left_traits::node const &y) {
+        auto &a_l = x.key;
+        auto &b_l = y.key;
+        auto &a_r = bimap_t::template key_of<right_traits>(&static_cast<node_t const &>(x));
+        auto &b_r = bimap_t::template key_of<right_traits>(&static_cast<node_t const &>(y));
+
+        return !(comp_left(a_l, b_l) || comp_left(b_l, a_l) || comp_right(a_r, b_r) || comp_right(b_r, a_r));
+    });
 }
 
-template <typename L, typename R, typename CL, typename CR>
-bool operator!=(bimap<L, R, CL, CR> const &a, bimap<L, R, CL, CR> const &b) noexcept
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+bool operator!=(bimap<L, R, CL, CR, N> const &a, bimap<L, R, CL, CR, N> const &b) noexcept
 {
     return !(a == b);
 }
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <future>
+#include <istream>
+#include <utility>
+#include <vector>
+
+#include "bimap.h"
+
+// Loads a bimap from a stream of pairs. Pairs are buffered in chunks, each
+// full chunk is sorted on a background thread while more pairs arrive, and
+// build() merges the sorted runs and links both trees in linear time. At most
+// hardware_concurrency threads work at once; if no thread can be started, the
+// work is done on the calling thread instead.
+// A pair clashing with an earlier one is skipped and reported in
+// duplicates(), as if the pairs were inserted one by one.
+template <typename Left, typename Right,
+    typename CompareLeft = std::less<Left>, typename CompareRight = std::less<Right>, std::size_t InlineCapacity = 0>
+struct bimap_builder
+{
+    using bimap_t = bimap<Left, Right, CompareLeft, CompareRight, InlineCapacity>;
+    using left_t = Left;
+    using right_t = Right;
+
+    static constexpr std::size_t default_chunk_size = 1 << 16;
+
+    explicit bimap_builder(std::size_t chunk_size = default_chunk_size,
+        CompareLeft compare_left = CompareLeft(), CompareRight compare_right = CompareRight());
+
+    bimap_builder(bimap_builder const &) = delete;
+    bimap_builder &operator=(bimap_builder const &) = delete;
+
+    ~bimap_builder();
+
+    void push(left_t left, right_t right);
+
+    // Reads whitespace-separated pairs until the end of the stream or the
+    // first malformed pair.
+    std::istream &read(std::istream &in);
+
+    // Produces the bimap from every pair pushed so far and resets the builder.
+    bimap_t build();
+
+    std::vector<std::pair<left_t, right_t>> const &duplicates() const noexcept;
+
+private:
+    using node_t = typename bimap_t::node_t;
+
+    struct run
+    {
+        std::vector<node_t *> nodes;
+        std::vector<std::size_t> by_left;
+        std::vector<std::size_t> by_right;
+        std::exception_ptr error;
+    };
+
+    std::size_t chunk_size;
+    unsigned threads;
+    bimap_t result;
+    std::vector<node_t *> pending;
+    std::deque<run> runs;
+    std::vector<std::future<void>> sorts;
+    std::vector<std::pair<left_t, right_t>> duplicate_pairs;
+
+    void submit();
+    void discard() noexcept;
+};
+
+#include "bimap_builder.tpp"
@@ -0,0 +1,150 @@
+#include "bimap_builder.h"
+
+#include <algorithm>
+#include <thread>
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+bimap_builder<L, R, CL, CR, N>::bimap_builder(std::size_t chunk_size, CL compare_left, CR compare_right) :
+    chunk_size(std::max<std::size_t>(chunk_size, 1)),
+    threads(std::max(std::thread::hardware_concurrency(), 2u)),
+    result(std::move(compare_left), std::move(compare_right))
+{}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+bimap_builder<L, R, CL, CR, N>::~bimap_builder()
+{
+    discard();
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+void bimap_builder<L, R, CL, CR, N>::push(left_t left, right_t right)
+{
+    auto *node = result.create_node(std::move(left), std::move(right));
+    try {
+        pending.push_back(node);
+    } catch (...) {
+        result.destroy_node(node);
+        throw;
+    }
+
+    if (pending.size() >= chunk_size) {
+        submit();
+    }
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+std::istream &bimap_builder<L, R, CL, CR, N>::read(std::istream &in)
+{
+    left_t left;
+    right_t right;
+    while (in >> left >> right) {
+        push(std::move(left), std::move(right));
+    }
+    return in;
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+typename bimap_builder<L, R, CL, CR, N>::bimap_t bimap_builder<L, R, CL, CR, N>::build()
+{
+    if (!pending.empty()) {
+        submit();
+    }
+    for (auto &sort : sorts) {
+        sort.wait();
+    }
+    sorts.clear();
+
+    std::vector<node_t *> nodes;
+    std::vector<std::size_t> by_left, by_right, bounds {0};
+    try {
+        std::size_t total = 0;
+        for (auto const &r : runs) {
+            if (r.error) {
+                std::rethrow_exception(r.error);
+            }
+            total += r.nodes.size();
+        }
+        nodes.reserve(total);
+        by_left.reserve(total);
+        by_right.reserve(total);
+        bounds.reserve(runs.size() + 1);
+
+        for (auto const &r : runs) {
+            auto offset = nodes.size();
+            nodes.insert(nodes.end(), r.nodes.begin(), r.nodes.end());
+            for (std::size_t i = 0; i < r.nodes.size(); ++i) {
+                by_left.push_back(r.by_left[i] + offset);
+                by_right.push_back(r.by_right[i] + offset);
+            }
+            bounds.push_back(nodes.size());
+        }
+    } catch (...) {
+        discard();
+        throw;
+    }
+    runs.clear();
+
+    try {
+        result.merge_bulk(nodes, by_left, by_right, bounds, threads, true);
+    } catch (...) {
+        for (auto *node : nodes) {
+            result.destroy_node(node);
+        }
+        throw;
+    }
+
+    std::vector<std::pair<left_t, right_t>> found;
+    result.link_bulk(nodes, by_left, by_right, [&found](left_t const &left, right_t const &right) {
+        found.emplace_back(left, right);
+    });
+    duplicate_pairs.swap(found);
+
+    bimap_t res(std::move(result));
+    return res;
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+std::vector<std::pair<L, R>> const &bimap_builder<L, R, CL, CR, N>::duplicates() const noexcept
+{
+    return duplicate_pairs;
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+void bimap_builder<L, R, CL, CR, N>::submit()
+{
+    if (sorts.size() >= threads) {
+        sorts[sorts.size() - threads].wait();
+    }
+    sorts.reserve(sorts.size() + 1);
+
+    auto &r = runs.emplace_back();
+    r.nodes.swap(pending);
+    sorts.push_back(bimap_t::spawn([this, &r] {
+        try {
+            result.sort_bulk(r.nodes, r.by_left, r.by_right, 1);
+        } catch (...) {
+            r.error = std::current_exception();
+        }
+    }));
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+void bimap_builder<L, R, CL, CR, N>::discard() noexcept
+{
+    for (auto &sort : sorts) {
+        sort.wait();
+    }
+    sorts.clear();
+
+    for (auto &r : runs) {
+        for (auto *node : r.nodes) {
+            result.destroy_node(node);
+        }
+    }
+    runs.clear();
+
+    for (auto *node : pending) {
+        result.destroy_node(node);
+    }
+    pending.clear();
+}
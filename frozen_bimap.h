@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <utility>
+
+// Immutable bimap over a fixed set of pairs, built at compile time. Pairs
+// are kept sorted by left key next to a permutation ordering them by right
+// key, so lookups are binary searches over a flat array.
+template <typename Left, typename Right, std::size_t N,
+    typename CompareLeft = std::less<Left>, typename CompareRight = std::less<Right>>
+struct frozen_bimap
+{
+    static_assert(N > 0, "frozen_bimap must not be empty");
+
+    using left_t = Left;
+    using right_t = Right;
+    using value_type = std::pair<left_t, right_t>;
+
+private:
+    struct left_tag;
+    struct right_tag;
+
+    template <typename T>
+    struct base_iterator
+    {
+        using iterator_category = std::bidirectional_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = std::conditional_t<std::is_same_v<T, left_tag>, left_t, right_t>;
+        using pointer = value_type const *;
+        using reference = value_type const &;
+        using flipped_iterator = base_iterator<std::conditional_t<std::is_same_v<T, left_tag>, right_tag, left_tag>>;
+
+        constexpr base_iterator() = default;
+
+        constexpr reference operator*() const noexcept;
+        constexpr pointer operator->() const noexcept;
+
+        constexpr base_iterator &operator++() noexcept;
+        constexpr base_iterator operator++(int) & noexcept;
+
+        constexpr base_iterator &operator--() noexcept;
+        constexpr base_iterator operator--(int) & noexcept;
+
+        constexpr bool operator==(base_iterator other) const noexcept;
+        constexpr bool operator!=(base_iterator other) const noexcept;
+
+        constexpr flipped_iterator flip() const noexcept;
+
+    private:
+        frozen_bimap const *map {};
+        std::size_t pos {};
+
+        constexpr base_iterator(frozen_bimap const *map, std::size_t pos) : map(map), pos(pos)
+        {}
+
+        friend struct frozen_bimap;
+        friend flipped_iterator;
+    };
+
+    using order_t = std::array<std::size_t, N>;
+
+public:
+    using left_iterator = base_iterator<left_tag>;
+    using right_iterator = base_iterator<right_tag>;
+
+    // Duplicate keys on either side make the table ill-formed: a compile
+    // error in constant evaluation, std::invalid_argument otherwise.
+    constexpr explicit frozen_bimap(value_type const (&pairs)[N],
+        CompareLeft compare_left = CompareLeft(), CompareRight compare_right = CompareRight());
+
+    constexpr left_iterator find_left(left_t const &left) const noexcept;
+    constexpr right_iterator find_right(right_t const &right) const noexcept;
+
+    constexpr right_t const &at_left(left_t const &key) const;
+    constexpr left_t const &at_right(right_t const &key) const;
+
+    constexpr left_iterator lower_bound_left(left_t const &left) const noexcept;
+    constexpr left_iterator upper_bound_left(left_t const &left) const noexcept;
+
+    constexpr right_iterator lower_bound_right(right_t const &right) const noexcept;
+    constexpr right_iterator upper_bound_right(right_t const &right) const noexcept;
+
+    constexpr left_iterator begin_left() const noexcept;
+    constexpr left_iterator end_left() const noexcept;
+
+    constexpr right_iterator begin_right() const noexcept;
+    constexpr right_iterator end_right() const noexcept;
+
+    constexpr bool empty() const noexcept;
+    constexpr std::size_t size() const noexcept;
+
+private:
+    std::array<value_type, N> pairs;
+    order_t by_right;
+    order_t right_pos;
+
+    [[no_unique_address]] CompareLeft compare_left;
+    [[no_unique_address]] CompareRight compare_right;
+
+    template <std::size_t... I>
+    constexpr frozen_bimap(value_type const (&pairs)[N], order_t const &by_left,
+        CompareLeft compare_left, CompareRight compare_right, std::index_sequence<I...>);
+
+    template <typename Less>
+    static constexpr order_t sorted_order(Less less);
+
+    template <typename Less>
+    static constexpr void sift_down(order_t &order, std::size_t i, std::size_t size, Less &less);
+
+    constexpr right_t const &right_at(std::size_t pos) const noexcept;
+
+    template <typename Key, typename Compare, typename Get>
+    static constexpr std::size_t lower_bound(Key const &key, Compare const &compare, Get get) noexcept;
+};
+
+template <typename L, typename R, typename CL = std::less<L>, typename CR = std::less<R>, std::size_t N>
+constexpr frozen_bimap<L, R, N, CL, CR> make_frozen_bimap(std::pair<L, R> const (&pairs)[N],
+    CL compare_left = CL(), CR compare_right = CR());
+
+#include "frozen_bimap.tpp"
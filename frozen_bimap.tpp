@@ -0,0 +1,296 @@
+#include "frozen_bimap.h"
+
+#include <stdexcept>
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+template <typename Tag>
+constexpr typename frozen_bimap<L, R, N, CL, CR>::template base_iterator<Tag>::reference frozen_bimap<L, R, N, CL, CR>::base_iterator<Tag>::operator*() const noexcept
+{
+    if constexpr (std::is_same_v<Tag, left_tag>) {
+        return map->pairs[pos].first;
+    } else {
+        return map->right_at(pos);
+    }
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+template <typename Tag>
+constexpr typename frozen_bimap<L, R, N, CL, CR>::template base_iterator<Tag>::pointer frozen_bimap<L, R, N, CL, CR>::base_iterator<Tag>::operator->() const noexcept
+{
+    return &this->operator*();
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+template <typename Tag>
+constexpr typename frozen_bimap<L, R, N, CL, CR>::template base_iterator<Tag> &frozen_bimap<L, R, N, CL, CR>::base_iterator<Tag>::operator++() noexcept
+{
+    ++pos;
+    return *this;
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+template <typename Tag>
+constexpr typename frozen_bimap<L, R, N, CL, CR>::template base_iterator<Tag> frozen_bimap<L, R, N, CL, CR>::base_iterator<Tag>::operator++(int) & noexcept
+{
+    auto res = *this;
+    ++pos;
+    return res;
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+template <typename Tag>
+constexpr typename frozen_bimap<L, R, N, CL, CR>::template base_iterator<Tag> &frozen_bimap<L, R, N, CL, CR>::base_iterator<Tag>::operator--() noexcept
+{
+    --pos;
+    return *this;
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+template <typename Tag>
+constexpr typename frozen_bimap<L, R, N, CL, CR>::template base_iterator<Tag> frozen_bimap<L, R, N, CL, CR>::base_iterator<Tag>::operator--(int) & noexcept
+{
+    auto res = *this;
+    --pos;
+    return res;
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+template <typename Tag>
+constexpr bool frozen_bimap<L, R, N, CL, CR>::base_iterator<Tag>::operator==(base_iterator other) const noexcept
+{
+    return map == other.map && pos == other.pos;
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+template <typename Tag>
+constexpr bool frozen_bimap<L, R, N, CL, CR>::base_iterator<Tag>::operator!=(base_iterator other) const noexcept
+{
+    return !(*this == other);
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+template <typename Tag>
+constexpr typename frozen_bimap<L, R, N, CL, CR>::template base_iterator<Tag>::flipped_iterator frozen_bimap<L, R, N, CL, CR>::base_iterator<Tag>::flip() const noexcept
+{
+    if (pos == N) {
+        return flipped_iterator(map, N);
+    }
+    if constexpr (std::is_same_v<Tag, left_tag>) {
+        return flipped_iterator(map, map->right_pos[pos]);
+    } else {
+        return flipped_iterator(map, map->by_right[pos]);
+    }
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+constexpr frozen_bimap<L, R, N, CL, CR>::frozen_bimap(value_type const (&pairs)[N], CL compare_left, CR compare_right) :
+    // compare_left is copied, not moved: the sort may run after the delegated
+    // constructor's arguments are initialized.
+    frozen_bimap(pairs,
+        sorted_order([&pairs, &compare_left](std::size_t a, std::size_t b) {
+            return compare_left(pairs[a].first, pairs[b].first);
+        }),
+        compare_left, std::move(compare_right), std::make_index_sequence<N>())
+{}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+template <std::size_t... I>
+constexpr frozen_bimap<L, R, N, CL, CR>::frozen_bimap(value_type const (&pairs)[N], order_t const &by_left,
+    CL compare_left, CR compare_right, std::index_sequence<I...>) :
+    pairs {{pairs[by_left[I]]...}},
+    by_right {},
+    right_pos {},
+    compare_left(std::move(compare_left)),
+    compare_right(std::move(compare_right))
+{
+    by_right = sorted_order([this](std::size_t a, std::size_t b) {
+        return this->compare_right(this->pairs[a].second, this->pairs[b].second);
+    });
+
+    for (std::size_t i = 0; i < N; ++i) {
+        right_pos[by_right[i]] = i;
+        if (i > 0 && !this->compare_left(this->pairs[i - 1].first, this->pairs[i].first)) {
+            throw std::invalid_argument("Duplicate left key");
+        }
+        if (i > 0 && !this->compare_right(right_at(i - 1), right_at(i))) {
+            throw std::invalid_argument("Duplicate right key");
+        }
+    }
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+template <typename Less>
+constexpr typename frozen_bimap<L, R, N, CL, CR>::order_t frozen_bimap<L, R, N, CL, CR>::sorted_order(Less less)
+{
+    order_t order {};
+    for (std::size_t i = 0; i < N; ++i) {
+        order[i] = i;
+    }
+
+    for (std::size_t i = N / 2; i-- > 0;) {
+        sift_down(order, i, N, less);
+    }
+    for (std::size_t end = N; end-- > 1;) {
+        auto tmp = order[0];
+        order[0] = order[end];
+        order[end] = tmp;
+        sift_down(order, 0, end, less);
+    }
+    return order;
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+template <typename Less>
+constexpr void frozen_bimap<L, R, N, CL, CR>::sift_down(order_t &order, std::size_t i, std::size_t size, Less &less)
+{
+    for (std::size_t child = 2 * i + 1; child < size; i = child, child = 2 * i + 1) {
+        if (child + 1 < size && less(order[child], order[child + 1])) {
+            ++child;
+        }
+        if (!less(order[i], order[child])) {
+            return;
+        }
+        auto tmp = order[i];
+        order[i] = order[child];
+        order[child] = tmp;
+    }
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+constexpr typename frozen_bimap<L, R, N, CL, CR>::right_t const &frozen_bimap<L, R, N, CL, CR>::right_at(std::size_t pos) const noexcept
+{
+    return pairs[by_right[pos]].second;
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+template <typename Key, typename Compare, typename Get>
+constexpr std::size_t frozen_bimap<L, R, N, CL, CR>::lower_bound(Key const &key, Compare const &compare, Get get) noexcept
+{
+    std::size_t first = 0;
+    for (std::size_t count = N; count > 0;) {
+        std::size_t step = count / 2;
+        if (compare(get(first + step), key)) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+    return first;
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+constexpr typename frozen_bimap<L, R, N, CL, CR>::left_iterator frozen_bimap<L, R, N, CL, CR>::find_left(left_t const &left) const noexcept
+{
+    auto it = lower_bound_left(left);
+    if (it != end_left() && compare_left(left, *it)) {
+        return end_left();
+    }
+    return it;
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+constexpr typename frozen_bimap<L, R, N, CL, CR>::right_iterator frozen_bimap<L, R, N, CL, CR>::find_right(right_t const &right) const noexcept
+{
+    auto it = lower_bound_right(right);
+    if (it != end_right() && compare_right(right, *it)) {
+        return end_right();
+    }
+    return it;
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+constexpr typename frozen_bimap<L, R, N, CL, CR>::right_t const &frozen_bimap<L, R, N, CL, CR>::at_left(left_t const &key) const
+{
+    if (auto it = find_left(key); it != end_left()) {
+        return *it.flip();
+    }
+    throw std::out_of_range("No such element");
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+constexpr typename frozen_bimap<L, R, N, CL, CR>::left_t const &frozen_bimap<L, R, N, CL, CR>::at_right(right_t const &key) const
+{
+    if (auto it = find_right(key); it != end_right()) {
+        return *it.flip();
+    }
+    throw std::out_of_range("No such element");
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+constexpr typename frozen_bimap<L, R, N, CL, CR>::left_iterator frozen_bimap<L, R, N, CL, CR>::lower_bound_left(left_t const &left) const noexcept
+{
+    return left_iterator(this, lower_bound(left, compare_left, [this](std::size_t pos) -> left_t const & {
+        return pairs[pos].first;
+    }));
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+constexpr typename frozen_bimap<L, R, N, CL, CR>::left_iterator frozen_bimap<L, R, N, CL, CR>::upper_bound_left(left_t const &left) const noexcept
+{
+    auto it = lower_bound_left(left);
+    if (it != end_left() && !compare_left(left, *it)) {
+        ++it;
+    }
+    return it;
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+constexpr typename frozen_bimap<L, R, N, CL, CR>::right_iterator frozen_bimap<L, R, N, CL, CR>::lower_bound_right(right_t const &right) const noexcept
+{
+    return right_iterator(this, lower_bound(right, compare_right, [this](std::size_t pos) -> right_t const & {
+        return right_at(pos);
+    }));
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+constexpr typename frozen_bimap<L, R, N, CL, CR>::right_iterator frozen_bimap<L, R, N, CL, CR>::upper_bound_right(right_t const &right) const noexcept
+{
+    auto it = lower_bound_right(right);
+    if (it != end_right() && !compare_right(right, *it)) {
+        ++it;
+    }
+    return it;
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+constexpr typename frozen_bimap<L, R, N, CL, CR>::left_iterator frozen_bimap<L, R, N, CL, CR>::begin_left() const noexcept
+{
+    return left_iterator(this, 0);
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+constexpr typename frozen_bimap<L, R, N, CL, CR>::left_iterator frozen_bimap<L, R, N, CL, CR>::end_left() const noexcept
+{
+    return left_iterator(this, N);
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+constexpr typename frozen_bimap<L, R, N, CL, CR>::right_iterator frozen_bimap<L, R, N, CL, CR>::begin_right() const noexcept
+{
+    return right_iterator(this, 0);
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+constexpr typename frozen_bimap<L, R, N, CL, CR>::right_iterator frozen_bimap<L, R, N, CL, CR>::end_right() const noexcept
+{
+    return right_iterator(this, N);
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+constexpr bool frozen_bimap<L, R, N, CL, CR>::empty() const noexcept
+{
+    return false;
+}
+
+template <typename L, typename R, std::size_t N, typename CL, typename CR>
+constexpr std::size_t frozen_bimap<L, R, N, CL, CR>::size() const noexcept
+{
+    return N;
+}
+
+template <typename L, typename R, typename CL, typename CR, std::size_t N>
+constexpr frozen_bimap<L, R, N, CL, CR> make_frozen_bimap(std::pair<L, R> const (&pairs)[N], CL compare_left, CR compare_right)
+{
+    return frozen_bimap<L, R, N, CL, CR>(pairs, std::move(compare_left), std::move(compare_right));
+}
@@ -79,12 +79,39 @@ struct set
     set(set const &) = delete;
     set &operator=(set const &) = delete;
 
-    set(set &&other) noexcept;
-    set &operator=(set &&other) noexcept;
+    // Exchanges contents only: each set keeps its own sentinel.
+    void swap(set &other) noexcept;
 
     iterator link(T &) noexcept;
     T &unlink(iterator it) noexcept;
 
+    // Puts replacement at the position of linked element, which must have an
+    // equivalent key, and leaves the element unlinked.
+    void substitute(T &element, T &replacement) noexcept;
+
+    // Links a strictly increasing range of T * into an empty set as a
+    // balanced tree in linear time.
+    template <typename RandomIt>
+    void link_sorted(RandomIt first, RandomIt last) noexcept;
+
+    // Calls f for every element in order. Unlike iterating, it needs no
+    // per-step end checks and prefetches the subtree visited next.
+    template <typename F>
+    void for_each(F &&f) const;
+
+    // Walks this set and other, which must have the same size, in order side
+    // by side; stops and returns false as soon as pred(x, y) does.
+    template <typename F>
+    bool equal(set const &other, F &&pred) const;
+
+    // Empties the set, handing every element to dispose in no particular
+    // order; dispose may destroy the element.
+    template <typename F>
+    void clear_and_dispose(F &&dispose) noexcept;
+
+    // Empties the set without touching the elements.
+    void clear() noexcept;
+
     iterator lower_bound(Key const &) const noexcept;
     iterator upper_bound(Key const &) const noexcept;
     iterator find(Key const &) const noexcept;
@@ -108,6 +135,13 @@ private:
     void splay(node_t *x) const noexcept;
     void replace(node_t const *old_child, node_t *new_child) const noexcept;
     node_t *lower_bound(Key const &, node_t *) const noexcept;
+
+    static void prefetch(node_t const *) noexcept;
+    static node_t const *first_node(node_t const *sentinel) noexcept;
+    static node_t const *next_node(node_t const *) noexcept;
+
+    template <typename RandomIt>
+    static node_t *link_sorted(RandomIt first, RandomIt last, node_t *parent) noexcept;
 };
 }
 
@@ -83,19 +83,17 @@ bool set<T, Key, Tag, Compare>::iterator::operator!=(iterator other) const noexc
 }
 
 template <typename T, typename Key, typename Tag, typename Compare>
-set<T, Key, Tag, Compare>::set(set &&other) noexcept :
-    sentinel(std::exchange(other.root, nullptr)),
-    sz(std::exchange(other.sz, 0)),
-    compare(std::move(other.compare))
-{}
-
-template <typename T, typename Key, typename Tag, typename Compare>
-set<T, Key, Tag, Compare> &set<T, Key, Tag, Compare>::operator=(set &&other) noexcept
+void set<T, Key, Tag, Compare>::swap(set &other) noexcept
 {
-    std::swap(sentinel, other.root);
+    std::swap(sentinel->left, other.sentinel->left);
+    if (sentinel->left) {
+        sentinel->left->parent = sentinel;
+    }
+    if (other.sentinel->left) {
+        other.sentinel->left->parent = other.sentinel;
+    }
     std::swap(sz, other.sz);
     std::swap(compare, other.compare);
-    return *this;
 }
 
 template <typename T, typename Key, typename Tag, typename Compare>
@@ -155,6 +153,86 @@ T &set<T, Key, Tag, Compare>::unlink(iterator it) noexcept
     return static_cast<T &>(*x);
 }
 
+template <typename T, typename Key, typename Tag, typename Compare>
+void set<T, Key, Tag, Compare>::substitute(T &element, T &replacement) noexcept
+{
+    node_t *x = &element;
+    node_t *y = &replacement;
+    assert(!x->is_sentinel());
+
+    y->left = x->left;
+    y->right = x->right;
+    if (y->left) {
+        y->left->parent = y;
+    }
+    if (y->right) {
+        y->right->parent = y;
+    }
+    replace(x, y);
+
+    x->left = x->right = nullptr;
+}
+
+template <typename T, typename Key, typename Tag, typename Compare>
+template <typename RandomIt>
+void set<T, Key, Tag, Compare>::link_sorted(RandomIt first, RandomIt last) noexcept
+{
+    assert(empty());
+    sentinel->left = link_sorted(first, last, sentinel);
+    sz = last - first;
+}
+
+template <typename T, typename Key, typename Tag, typename Compare>
+template <typename F>
+void set<T, Key, Tag, Compare>::for_each(F &&f) const
+{
+    for (node_t const *x = first_node(sentinel); x != sentinel; x = next_node(x)) {
+        prefetch(x->right);
+        f(static_cast<T const &>(*x));
+    }
+}
+
+template <typename T, typename Key, typename Tag, typename Compare>
+template <typename F>
+bool set<T, Key, Tag, Compare>::equal(set const &other, F &&pred) const
+{
+    node_t const *y = first_node(other.sentinel);
+    for (node_t const *x = first_node(sentinel); x != sentinel; x = next_node(x), y = next_node(y)) {
+        prefetch(x->right);
+        prefetch(y->right);
+        if (!pred(static_cast<T const &>(*x), static_cast<T const &>(*y))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T, typename Key, typename Tag, typename Compare>
+template <typename F>
+void set<T, Key, Tag, Compare>::clear_and_dispose(F &&dispose) noexcept
+{
+    node_t *x = sentinel->left;
+    while (x) {
+        if (node_t *y = x->left) {
+            x->left = y->right;
+            y->right = x;
+            x = y;
+        } else {
+            node_t *next = x->right;
+            dispose(static_cast<T &>(*x));
+            x = next;
+        }
+    }
+    clear();
+}
+
+template <typename T, typename Key, typename Tag, typename Compare>
+void set<T, Key, Tag, Compare>::clear() noexcept
+{
+    sentinel->left = nullptr;
+    sz = 0;
+}
+
 template <typename T, typename Key, typename Tag, typename Compare>
 typename set<T, Key, Tag, Compare>::iterator set<T, Key, Tag, Compare>::lower_bound(Key const &key) const noexcept
 {
@@ -302,4 +380,55 @@ typename set<T, Key, Tag, Compare>::node_t *set<T, Key, Tag, Compare>::lower_bou
 
     return x;
 }
+
+template <typename T, typename Key, typename Tag, typename Compare>
+void set<T, Key, Tag, Compare>::prefetch([[maybe_unused]] node_t const *ptr) noexcept
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(ptr);
+#endif
+}
+
+template <typename T, typename Key, typename Tag, typename Compare>
+typename set<T, Key, Tag, Compare>::node_t const *set<T, Key, Tag, Compare>::first_node(node_t const *sentinel) noexcept
+{
+    node_t const *x = sentinel;
+    while (x->left) {
+        x = x->left;
+    }
+    return x;
+}
+
+template <typename T, typename Key, typename Tag, typename Compare>
+typename set<T, Key, Tag, Compare>::node_t const *set<T, Key, Tag, Compare>::next_node(node_t const *x) noexcept
+{
+    if (x->right) {
+        x = x->right;
+        while (x->left) {
+            prefetch(x->right);
+            x = x->left;
+        }
+        return x;
+    }
+    while (x != x->parent->left) {
+        x = x->parent;
+    }
+    return x->parent;
+}
+
+template <typename T, typename Key, typename Tag, typename Compare>
+template <typename RandomIt>
+typename set<T, Key, Tag, Compare>::node_t *set<T, Key, Tag, Compare>::link_sorted(RandomIt first, RandomIt last, node_t *parent) noexcept
+{
+    if (first == last) {
+        return nullptr;
+    }
+
+    auto mid = first + (last - first) / 2;
+    node_t *x = static_cast<T *>(*mid);
+    x->parent = parent;
+    x->left = link_sorted(first, mid, x);
+    x->right = link_sorted(mid + 1, last, x);
+    return x;
+}
 }
\ No newline at end of file
@@ -51,3 +51,26 @@ private:
   int a;
 };
 
+struct throwing_key {
+  static inline bool throw_on_copy = false;
+
+  int a;
+  explicit throwing_key(int b) : a(b) {}
+  throwing_key(throwing_key const &other) : a(other.a) {
+    if (throw_on_copy) {
+      throw std::runtime_error("copy");
+    }
+  }
+  throwing_key &operator=(throwing_key const &) {
+    throw std::runtime_error("assign");
+  }
+  friend bool operator<(throwing_key const &c, throwing_key const &b) {
+    return c.a < b.a;
+  }
+};
+
+struct stateful_less {
+  std::shared_ptr<bool> descending = std::make_shared<bool>(false);
+
+  bool operator()(int a, int b) const { return *descending ? b < a : a < b; }
+};
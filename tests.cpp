@@ -1,6 +1,11 @@
+#include <memory>
 #include <random>
+#include <sstream>
+#include <string_view>
 
 #include "bimap.h"
+#include "bimap_builder.h"
+#include "frozen_bimap.h"
 #include "test-classes.h"
 #include "gtest/gtest.h"
 
@@ -65,6 +70,57 @@ TEST(bimap, copies) {
   b1.insert(10, -10);
   b = b1;
   EXPECT_NE(b.find_right(-10), b.end_right());
+
+  bimap<int, int, std::greater<>> c;
+  for (int i = 0; i < 1000; i++) {
+    c.insert(i * 7 % 1000, i * 13 % 1000);
+  }
+  auto c1 = c;
+  EXPECT_EQ(c, c1);
+  auto it = c1.begin_right();
+  for (auto src = c.begin_right(); src != c.end_right(); ++src, ++it) {
+    EXPECT_EQ(*it, *src);
+    EXPECT_EQ(*it.flip(), *src.flip());
+  }
+}
+
+TEST(bimap, equality_without_fingerprint) {
+  using key = non_default_constructible;
+  bimap<key, int> a, b;
+  for (int i = 0; i < 100; i++) {
+    a.insert(key(i), i * 3 % 100);
+    b.insert(key(99 - i), (99 - i) * 3 % 100);
+  }
+  EXPECT_EQ(a, b);
+
+  a.replace_right(a.find_right(42), 100);
+  b.replace_right(b.find_right(42), 101);
+  EXPECT_NE(a, b);
+  b.replace_right(b.find_right(101), 100);
+  EXPECT_EQ(a, b);
+
+  b.replace_left(b.find_left(key(99)), key(100));
+  EXPECT_NE(a, b);
+}
+
+TEST(bimap, range_constructor) {
+  std::vector<std::pair<int, int>> pairs = {
+      {5, 50}, {1, 10}, {3, 10}, {1, 20}, {3, 30}, {4, 40}, {2, 40}};
+  bimap<int, int> b(pairs.begin(), pairs.end());
+
+  bimap<int, int> expected;
+  for (auto const &p : pairs) {
+    expected.insert(p.first, p.second);
+  }
+  EXPECT_EQ(b.size(), 4);
+  EXPECT_EQ(b, expected);
+  EXPECT_EQ(b.at_left(3), 30);
+  EXPECT_EQ(b.find_left(2), b.end_left());
+
+  bimap<int, int, std::greater<>> empty(pairs.end(), pairs.end());
+  EXPECT_TRUE(empty.empty());
+  empty.insert(1, 2);
+  EXPECT_EQ(empty.at_right(2), 1);
 }
 
 TEST(bimap, insert) {
@@ -131,6 +187,84 @@ TEST(bimap, at_or_default) {
   EXPECT_EQ(b.at_left(0), 1000);
 }
 
+TEST(bimap, at_or_default_order) {
+  bimap<int, int> b;
+  b.insert(1, 0);
+  b.insert(2, 5);
+  b.insert(3, 7);
+
+  EXPECT_EQ(b.at_left_or_default(10), 0);
+  EXPECT_EQ(b.find_left(1), b.end_left());
+  EXPECT_EQ(*std::prev(b.end_left()), 10);
+  EXPECT_EQ(*b.find_left(10).flip(), 0);
+
+  b.insert(0, 3);
+  EXPECT_EQ(b.at_right_or_default(-1), 0);
+  EXPECT_EQ(b.find_right(3), b.end_right());
+  EXPECT_EQ(*b.begin_right(), -1);
+  EXPECT_EQ(*b.find_right(-1).flip(), 0);
+}
+
+TEST(bimap, replace) {
+  bimap<int, int> b;
+  b.insert(1, 10);
+  b.insert(2, 20);
+  b.insert(3, 30);
+
+  auto held = b.find_right(20);
+  auto it = b.replace_left(b.find_left(2), 5);
+  EXPECT_EQ(*it, 5);
+  EXPECT_EQ(held.flip(), it);
+  EXPECT_EQ(*it.flip(), 20);
+  EXPECT_EQ(b.find_left(2), b.end_left());
+  EXPECT_EQ(b.at_right(20), 5);
+  EXPECT_EQ(*std::prev(b.end_left()), 5);
+
+  EXPECT_EQ(b.replace_left(b.find_left(1), 3), b.end_left());
+  EXPECT_EQ(b.at_left(1), 10);
+  EXPECT_EQ(b.at_left(3), 30);
+
+  auto rit = b.replace_right(b.find_right(10), 40);
+  EXPECT_EQ(*rit, 40);
+  EXPECT_EQ(*rit.flip(), 1);
+  EXPECT_EQ(b.at_left(1), 40);
+  EXPECT_EQ(*std::prev(b.end_right()), 40);
+  EXPECT_EQ(b.replace_right(b.find_right(40), 20), b.end_right());
+
+  EXPECT_EQ(*b.replace_right(b.find_right(40), 40), 40);
+  EXPECT_EQ(b.size(), 3);
+
+  bimap<int, int> c;
+  c.insert(5, 20);
+  c.insert(3, 30);
+  c.insert(1, 40);
+  EXPECT_EQ(b, c);
+}
+
+TEST(bimap, replace_throwing_key) {
+  bimap<throwing_key, int> b;
+  b.insert(throwing_key(1), 10);
+  b.insert(throwing_key(2), 20);
+
+  // The held right iterator is invalidated: the pair moves to a new node.
+  auto it = b.replace_left(b.find_left(throwing_key(1)), throwing_key(5));
+  EXPECT_EQ(it->a, 5);
+  EXPECT_EQ(*it.flip(), 10);
+  EXPECT_EQ(b.find_right(10).flip(), it);
+  EXPECT_EQ(b.at_right(10).a, 5);
+  EXPECT_EQ(b.size(), 2);
+
+  throwing_key::throw_on_copy = true;
+  EXPECT_THROW(b.replace_left(b.find_left(throwing_key(2)), throwing_key(7)),
+               std::runtime_error);
+  throwing_key::throw_on_copy = false;
+  EXPECT_EQ(b.size(), 2);
+  EXPECT_EQ(b.at_right(20).a, 2);
+  EXPECT_EQ(b.at_left(throwing_key(2)), 20);
+  EXPECT_EQ(b.begin_left()->a, 2);
+  EXPECT_EQ(std::next(b.begin_left())->a, 5);
+}
+
 TEST(bimap, end_flip) {
   bimap<int, int> b;
   EXPECT_EQ(b.end_left().flip(), b.end_right());
@@ -243,6 +377,36 @@ TEST(bimap, erase_range) {
   EXPECT_TRUE(b.empty());
 }
 
+TEST(bimap, for_each) {
+  bimap<int, int> b;
+  b.for_each_left([](int, int) { FAIL(); });
+  for (int i = 0; i < 100; i++) {
+    b.insert((i * 37) % 100, (i * 53) % 100 - 50);
+  }
+
+  auto lit = b.begin_left();
+  b.for_each_left([&](int l, int r) {
+    EXPECT_EQ(l, *lit);
+    EXPECT_EQ(r, *lit.flip());
+    ++lit;
+  });
+  EXPECT_EQ(lit, b.end_left());
+
+  auto rit = b.begin_right();
+  b.for_each_right([&](int l, int r) {
+    EXPECT_EQ(r, *rit);
+    EXPECT_EQ(l, *rit.flip());
+    ++rit;
+  });
+  EXPECT_EQ(rit, b.end_right());
+
+  b.erase_right(b.begin_right(), b.end_right());
+  EXPECT_TRUE(b.empty());
+  EXPECT_EQ(b.begin_left(), b.end_left());
+  b.insert(1, 2);
+  EXPECT_EQ(b.at_right(2), 1);
+}
+
 TEST(bimap, lower_bound) {
   bimap<int, int> b;
 
@@ -310,6 +474,60 @@ TEST(bimap, equivalence) {
   EXPECT_EQ(a.end_right().flip(), a.end_left());
 }
 
+TEST(bimap, fingerprint) {
+  bimap<int, int> a;
+  bimap<int, int> b;
+  EXPECT_EQ(a.fingerprint(), b.fingerprint());
+
+  a.insert(1, 2);
+  a.insert(3, 4);
+  a.insert(5, 6);
+  b.insert(5, 6);
+  b.insert(3, 4);
+  EXPECT_NE(a.fingerprint(), b.fingerprint());
+  b.insert(1, 2);
+  EXPECT_EQ(a.fingerprint(), b.fingerprint());
+
+  b.erase_left(3);
+  b.insert(3, 7);
+  EXPECT_NE(a.fingerprint(), b.fingerprint());
+  EXPECT_NE(a, b);
+
+  b.erase_right(7);
+  b.insert(3, 4);
+  EXPECT_EQ(a.fingerprint(), b.fingerprint());
+  EXPECT_EQ(a, b);
+
+  bimap<int, int> c(a);
+  EXPECT_EQ(a.fingerprint(), c.fingerprint());
+  c.erase_left(c.begin_left(), c.end_left());
+  EXPECT_EQ(c.fingerprint(), (bimap<int, int>().fingerprint()));
+}
+
+struct partial_key {
+  int key;
+  int payload;
+  friend bool operator<(partial_key const &a, partial_key const &b) {
+    return a.key < b.key;
+  }
+};
+
+namespace std {
+template <>
+struct hash<partial_key> {
+  size_t operator()(partial_key const &k) const {
+    return hash<int>()(k.key) * 31 + hash<int>()(k.payload);
+  }
+};
+} // namespace std
+
+TEST(bimap, fingerprint_partial_key) {
+  bimap<partial_key, int> a, b;
+  a.insert({1, 10}, 1);
+  b.insert({1, 20}, 1);
+  EXPECT_EQ(a, b);
+}
+
 TEST(bimap, iterator_ops) {
   bimap<int, int> b;
   b.insert(3, 4);
@@ -334,6 +552,169 @@ TEST(bimap, swap) {
   EXPECT_EQ(*b.find_right(3), 3);
 }
 
+TEST(bimap, move) {
+  bimap<int, int> b;
+  b.insert(1, 2);
+  b.insert(3, 4);
+  auto it = b.find_left(3);
+
+  bimap<int, int> b1(std::move(b));
+  EXPECT_TRUE(b.empty());
+  EXPECT_EQ(b1.size(), 2);
+  EXPECT_EQ(it, b1.find_left(3));
+  EXPECT_EQ(b1.at_right(2), 1);
+  EXPECT_EQ(std::next(it), b1.end_left());
+  EXPECT_EQ(b.begin_left(), b.end_left());
+
+  b.insert(5, 6);
+  b = std::move(b1);
+  EXPECT_EQ(b.size(), 2);
+  EXPECT_EQ(b.find_left(5), b.end_left());
+  EXPECT_EQ(*b.find_right(4).flip(), 3);
+
+  b = std::move(b);
+  EXPECT_EQ(b.size(), 2);
+}
+
+TEST(bimap, vector_of_bimaps) {
+  std::vector<bimap<int, int>> shards;
+  for (int i = 0; i < 100; i++) {
+    shards.emplace_back();
+    shards.back().insert(i, -i);
+    shards.back().insert(i + 1000, i + 1000);
+  }
+  std::swap(shards.front(), shards.back());
+
+  for (int i = 0; i < 100; i++) {
+    int shard = i == 0 ? 99 : i == 99 ? 0 : i;
+    EXPECT_EQ(shards[shard].size(), 2);
+    EXPECT_EQ(shards[shard].at_left(i), -i);
+    EXPECT_EQ(*shards[shard].begin_right(), -i);
+    EXPECT_EQ(*std::prev(shards[shard].end_left()), i + 1000);
+  }
+}
+
+template <typename Map>
+bool stored_inline(Map const &m, typename Map::left_iterator it) {
+  auto *ptr = reinterpret_cast<char const *>(&*it);
+  auto *begin = reinterpret_cast<char const *>(&m);
+  return begin <= ptr && ptr < begin + sizeof(m);
+}
+
+TEST(bimap, inline_storage) {
+  using small_bimap = bimap<int, int, std::less<>, std::less<>, 4>;
+  small_bimap b;
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(stored_inline(b, b.insert(i, -i)));
+  }
+  EXPECT_FALSE(stored_inline(b, b.insert(10, 10)));
+
+  b.erase_left(2);
+  EXPECT_TRUE(stored_inline(b, b.insert(20, 20)));
+  EXPECT_FALSE(stored_inline(b, b.insert(30, 30)));
+
+  small_bimap c(std::move(b));
+  EXPECT_TRUE(b.empty());
+  EXPECT_EQ(c.size(), 6);
+  EXPECT_TRUE(stored_inline(c, c.find_left(20)));
+  EXPECT_EQ(c.at_left(3), -3);
+  EXPECT_EQ(*c.find_right(-1).flip(), 1);
+
+  small_bimap d;
+  d.insert(100, 100);
+  d.swap(c);
+  EXPECT_EQ(c.size(), 1);
+  EXPECT_EQ(d.size(), 6);
+  EXPECT_TRUE(stored_inline(c, c.find_left(100)));
+  EXPECT_TRUE(stored_inline(d, d.find_left(0)));
+  EXPECT_FALSE(stored_inline(d, d.find_left(30)));
+
+  small_bimap expected;
+  for (int i : {0, 1, 3, 10, 20, 30}) {
+    expected.insert(i, d.at_left(i));
+  }
+  EXPECT_EQ(d, expected);
+
+  std::vector<std::pair<int, int>> pairs = {{1, 1}, {2, 2}, {3, 3}, {4, 4}, {5, 5}};
+  small_bimap e(pairs.begin(), pairs.end());
+  EXPECT_TRUE(stored_inline(e, e.find_left(1)));
+  EXPECT_EQ(e.size(), 5);
+
+  bimap<int, int, std::less<>, std::less<>, 64> full;
+  for (int i = 0; i < 64; i++) {
+    EXPECT_TRUE(stored_inline(full, full.insert(i, i)));
+  }
+  EXPECT_FALSE(stored_inline(full, full.insert(64, 64)));
+  full.erase_left(17);
+  EXPECT_TRUE(stored_inline(full, full.insert(100, 100)));
+}
+
+enum class opcode { nop, load, store, jump };
+
+constexpr auto opcodes = make_frozen_bimap<opcode, std::string_view>({
+    {opcode::store, "store"},
+    {opcode::nop, "nop"},
+    {opcode::jump, "jump"},
+    {opcode::load, "load"},
+});
+
+static_assert(opcodes.size() == 4);
+static_assert(opcodes.at_left(opcode::jump) == "jump");
+static_assert(opcodes.at_right("load") == opcode::load);
+static_assert(opcodes.find_right("halt") == opcodes.end_right());
+static_assert(*opcodes.begin_left() == opcode::nop);
+static_assert(*opcodes.begin_right() == "jump");
+static_assert(*opcodes.find_left(opcode::store).flip() == "store");
+
+TEST(frozen_bimap, lookup) {
+  EXPECT_EQ(opcodes.at_left(opcode::nop), "nop");
+  EXPECT_EQ(opcodes.at_right("store"), opcode::store);
+  EXPECT_THROW(opcodes.at_right("halt"), std::out_of_range);
+  EXPECT_EQ(opcodes.end_left().flip(), opcodes.end_right());
+  EXPECT_EQ(opcodes.end_right().flip(), opcodes.end_left());
+
+  std::vector<std::string_view> names(opcodes.begin_right(),
+                                      opcodes.end_right());
+  EXPECT_EQ(names, (std::vector<std::string_view>{"jump", "load", "nop",
+                                                  "store"}));
+  for (auto it = opcodes.begin_left(); it != opcodes.end_left(); ++it) {
+    EXPECT_EQ(*it.flip().flip(), *it);
+    EXPECT_EQ(opcodes.at_right(*it.flip()), *it);
+  }
+}
+
+TEST(frozen_bimap, bounds_and_comparators) {
+  constexpr auto b = make_frozen_bimap<int, int, std::greater<int>>(
+      {{1, 10}, {5, 50}, {3, 30}});
+  static_assert(*b.begin_left() == 5);
+  static_assert(*b.lower_bound_left(4) == 3);
+  static_assert(*b.upper_bound_left(3) == 1);
+  static_assert(*b.lower_bound_right(20) == 30);
+  static_assert(b.upper_bound_right(50) == b.end_right());
+
+  int prev = *b.begin_left();
+  for (auto it = std::next(b.begin_left()); it != b.end_left(); ++it) {
+    EXPECT_GT(prev, *it);
+    prev = *it;
+  }
+
+  std::pair<int, int> const pairs[] = {{1, 2}, {3, 2}};
+  EXPECT_THROW((frozen_bimap<int, int, 2>(pairs)), std::invalid_argument);
+}
+
+TEST(frozen_bimap, stateful_comparator) {
+  std::pair<int, int> const pairs[] = {{2, 20}, {3, 10}, {1, 30}};
+  stateful_less descending;
+  *descending.descending = true;
+  frozen_bimap<int, int, 3, stateful_less, stateful_less> b(pairs, descending);
+
+  EXPECT_EQ(*b.begin_left(), 3);
+  EXPECT_EQ(*std::prev(b.end_left()), 1);
+  EXPECT_EQ(*b.begin_right(), 10);
+  EXPECT_EQ(b.at_left(1), 30);
+  EXPECT_EQ(b.at_right(20), 2);
+}
+
 template <typename T>
 std::vector<std::pair<T, T>>
 eliminate_same(std::vector<T> &lefts, std::vector<T> &rights, std::mt19937 &e) {
@@ -359,6 +740,7 @@ eliminate_same(std::vector<T> &lefts, std::vector<T> &rights, std::mt19937 &e) {
 }
 
 template struct bimap<int, non_default_constructible>;
+template struct bimap<int, int, std::less<int>, std::less<int>, 16>;
 template struct bimap<non_default_constructible, int>;
 
 static constexpr uint32_t seed = 1488228;
@@ -390,6 +772,118 @@ TEST(bimap_randomized, comparison) {
 
   EXPECT_EQ(b1.size(), b2.size());
   EXPECT_EQ(b1, b2);
+
+  bimap<uint32_t, uint32_t> b3(b1);
+  EXPECT_EQ(b3, b2);
+  b3.erase_left(b3.begin_left());
+  EXPECT_NE(b3, b2);
+}
+
+TEST(bimap_randomized, range_constructor) {
+  std::mt19937 e(seed);
+  std::vector<std::pair<uint32_t, uint32_t>> pairs(100000);
+  for (auto &p : pairs) {
+    p = {e() % 200000, e() % 200000};
+  }
+
+  bimap<uint32_t, uint32_t> b(pairs.begin(), pairs.end());
+  bimap<uint32_t, uint32_t> expected;
+  for (auto const &p : pairs) {
+    expected.insert(p.first, p.second);
+  }
+
+  EXPECT_EQ(b.size(), expected.size());
+  EXPECT_EQ(b, expected);
+  EXPECT_EQ(b.fingerprint(), expected.fingerprint());
+
+  for (size_t i = 0; i < 1000; i++) {
+    uint32_t l = e() % 200000, r = e() % 200000;
+    if (i % 2 == 0) {
+      EXPECT_EQ(b.erase_left(l), expected.erase_left(l));
+    } else {
+      EXPECT_EQ(b.insert(l, r) == b.end_left(),
+                expected.insert(l, r) == expected.end_left());
+    }
+  }
+  EXPECT_EQ(b, expected);
+}
+
+TEST(bimap_randomized, inline_storage) {
+  bimap<int, int, std::less<int>, std::less<int>, 16> b, b1;
+  bimap<int, int> expected;
+
+  std::mt19937 e(seed);
+  for (size_t i = 0; i < 20000; i++) {
+    int l = e() % 64, r = e() % 64;
+    if (e() % 2 == 0) {
+      b.insert(l, r);
+      expected.insert(l, r);
+    } else {
+      b.erase_left(l);
+      expected.erase_left(l);
+    }
+    if (i % 100 == 0) {
+      b.swap(b1);
+      b = std::move(b1);
+      ASSERT_EQ(b.size(), expected.size());
+      auto it = b.begin_left();
+      for (auto eit = expected.begin_left(); eit != expected.end_left();
+           ++eit, ++it) {
+        EXPECT_EQ(*it, *eit);
+        EXPECT_EQ(*it.flip(), *eit.flip());
+      }
+    }
+  }
+}
+
+TEST(bimap_builder, read) {
+  std::istringstream in("1 one\n2 two\n3 one\n\n4 four 5");
+  bimap_builder<int, std::string> builder(2);
+  builder.read(in);
+  EXPECT_TRUE(in.eof());
+
+  auto b = builder.build();
+  EXPECT_EQ(b.size(), 3);
+  EXPECT_EQ(b.at_left(2), "two");
+  EXPECT_EQ(b.at_right("one"), 1);
+  EXPECT_EQ(b.find_left(5), b.end_left());
+  ASSERT_EQ(builder.duplicates().size(), 1);
+  EXPECT_EQ(builder.duplicates()[0], (std::pair<int, std::string>(3, "one")));
+
+  builder.push(7, "seven");
+  auto b1 = builder.build();
+  EXPECT_EQ(b1.size(), 1);
+  EXPECT_TRUE(builder.duplicates().empty());
+  EXPECT_TRUE(builder.build().empty());
+
+  bimap_builder<int, std::string> abandoned(1);
+  abandoned.push(1, "one");
+  abandoned.push(2, "two");
+}
+
+void check_builder(size_t chunk_size, size_t count) {
+  std::mt19937 e(seed);
+  bimap_builder<uint32_t, uint32_t> builder(chunk_size);
+  bimap<uint32_t, uint32_t> expected;
+  std::vector<std::pair<uint32_t, uint32_t>> expected_duplicates;
+
+  for (size_t i = 0; i < count; i++) {
+    uint32_t l = e() % (2 * count), r = e() % (2 * count);
+    builder.push(l, r);
+    if (expected.insert(l, r) == expected.end_left()) {
+      expected_duplicates.emplace_back(l, r);
+    }
+  }
+
+  auto b = builder.build();
+  EXPECT_EQ(b.size(), expected.size());
+  EXPECT_EQ(b, expected);
+  EXPECT_EQ(builder.duplicates(), expected_duplicates);
+}
+
+TEST(bimap_randomized, builder) {
+  check_builder(1000, 50000);
+  check_builder(7, 2000);
 }
 
 TEST(bimap_randomized, invariant_check) {